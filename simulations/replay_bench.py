@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+"""Replay every canned trace against SmartServer and print throughput and latency percentiles.
+
+Latencies are in seconds; throughput is responses per wall-clock second.
+
+Usage: ./replay_bench.py [--recorded-timing] [trace ...]
+"""
+import os
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, "traces"))
+import make_traces  # noqa: E402
+
+# wallLatency*: real time to answer each request; latency*: simulated response time
+COLUMNS = ["messagesReplayed", "responses", "throughput",
+           "wallLatencyP50", "wallLatencyP90", "wallLatencyP99", "wallLatencyMax",
+           "latencyP50", "latencyP99"]
+
+
+def read_scalars(path):
+    scalars = {}
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) == 4 and fields[0] == "scalar" and fields[1].endswith(".replayer"):
+                scalars[fields[2]] = float(fields[3])
+    return scalars
+
+
+def run_trace(name, full_speed):
+    trace = os.path.join("traces", name + ".trace")
+    sca = os.path.join("results", "replay-%s.sca" % name)
+    subprocess.run(["./run", "-u", "Cmdenv", "-c", "TraceReplay",
+                    "--**.replayer.traceFile=\"%s\"" % trace,
+                    "--**.replayer.fullSpeed=%s" % ("true" if full_speed else "false"),
+                    "--output-scalar-file=%s" % sca],
+                   cwd=HERE, check=True, stdout=subprocess.DEVNULL)
+    return read_scalars(os.path.join(HERE, sca))
+
+
+def main(args):
+    full_speed = "--recorded-timing" not in args
+    names = [a for a in args if not a.startswith("--")] or list(make_traces.TRACES)
+
+    tracedir = os.path.join(HERE, "traces")
+    if any(not os.path.exists(os.path.join(tracedir, n + ".trace")) for n in names):
+        make_traces.main(tracedir)
+
+    print("%-18s" % "trace" + "".join("%14s" % c for c in COLUMNS))
+    for name in names:
+        scalars = run_trace(name, full_speed)
+        print("%-18s" % name + "".join("%14.6g" % scalars.get(c, 0) for c in COLUMNS))
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""Generate the canned SmartServer traces used by replay_bench.py.
+
+Writes the binary format read by TraceReplayer (see src/TraceFile.h).
+Traces are generated from fixed seeds, so they are identical on every run.
+
+Clients follow the DHCP handshake: each REQUEST asks for the address the
+server would have offered, assuming the TraceReplay config's pool and the
+default sequential allocation policy.
+"""
+import heapq
+import os
+import random
+import struct
+import sys
+
+DHCP_DISCOVER = 1
+DHCP_REQUEST = 3
+DNS_QUERY = 5
+
+# Pool of the TraceReplay config: 192.168.1.2-192.168.1.254
+POOL_FIRST = (192 << 24) | (168 << 16) | (1 << 8) | 2
+POOL_LAST = (192 << 24) | (168 << 16) | (1 << 8) | 254
+
+
+def encode_string(s):
+    data = s.encode()[:255]
+    return bytes([len(data)]) + data
+
+
+def encode_record(time, type, gate, mac="", hostname="", requested_ip="", attack=False, serial=0):
+    return (struct.pack("<dBIBI", time, type, gate, 1 if attack else 0, serial)
+            + encode_string(mac) + encode_string(hostname) + encode_string(requested_ip))
+
+
+def client_mac(gate):
+    return "AA:BB:CC:DD:EE:%02d" % (gate + 1)
+
+
+def ip_string(ip):
+    return "%d.%d.%d.%d" % (ip >> 24, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF)
+
+
+def boot(records, rng, clients, window):
+    """Every client does DISCOVER + REQUEST (for the offered address) within the window."""
+    for gate in range(clients):
+        t = rng.uniform(0, window)
+        records.append((t, DHCP_DISCOVER, gate, client_mac(gate), "", "", False))
+        records.append((t + 0.002, DHCP_REQUEST, gate, client_mac(gate), "", None, False))
+
+
+def renewals(records, rng, clients, start, end, period):
+    for gate in range(clients):
+        t = start + rng.uniform(0, period)
+        while t < end:
+            records.append((t, DHCP_REQUEST, gate, client_mac(gate), "", None, False))
+            t += period
+
+
+def follow_handshake(records):
+    """Replay the server's sequential allocation to fill in requested addresses.
+
+    REQUESTs with address None ask for the gate's bound or offered address;
+    clients that never got an offer (pool exhausted) send no REQUEST.
+    """
+    records.sort(key=lambda r: r[0])
+    free = list(range(POOL_FIRST, POOL_LAST + 1))
+    heapq.heapify(free)
+    offered = {}
+    bound = {}
+    result = []
+
+    for t, type, gate, mac, hostname, ip, attack in records:
+        if type == DHCP_DISCOVER:
+            # The server re-offers a bound client its address (leases keyed by gate)
+            if gate in bound:
+                offered[gate] = bound[gate]
+            elif free:
+                offered[gate] = heapq.heappop(free)
+            else:
+                offered.pop(gate, None)
+        elif type == DHCP_REQUEST and ip is None:
+            address = bound.get(gate, offered.get(gate))
+            if address is None:
+                continue
+            bound[gate] = address
+            ip = ip_string(address)
+        result.append((t, type, gate, mac, hostname, ip, attack))
+    return result
+
+
+def boot_storm(rng):
+    records = []
+    boot(records, rng, 200, 0.5)
+    return records
+
+
+def steady_renewal(rng):
+    records = []
+    boot(records, rng, 200, 5.0)
+    renewals(records, rng, 200, 5.0, 300.0, 30.0)
+    return records
+
+
+def starvation_attack(rng):
+    records = []
+    boot(records, rng, 50, 5.0)
+    renewals(records, rng, 50, 5.0, 60.0, 30.0)
+    t = 1.0
+    while t < 60.0:
+        mac = "FF:FF:FF:FF:%02X:%02X" % (rng.randint(0, 255), rng.randint(0, 255))
+        records.append((t, DHCP_DISCOVER, 250, mac, "", "", True))
+        t += rng.expovariate(200.0)
+    return records
+
+
+def dns_heavy(rng):
+    records = []
+    boot(records, rng, 50, 1.0)
+    t = 2.0
+    while t < 22.0:
+        gate = rng.randrange(50)
+        target = rng.randrange(60)  # some names do not exist
+        records.append((t, DNS_QUERY, gate, "", "host-%02d" % target, "", False))
+        t += rng.expovariate(1000.0)
+    return records
+
+
+def mass_expiry(rng):
+    """100k clients bind within one second, so their leases all expire together."""
+    records = []
+    for gate in range(100000):
+        t = rng.uniform(0, 1.0)
+        ip = "10.%d.%d.%d" % ((gate + 1) >> 16, ((gate + 1) >> 8) & 0xFF, (gate + 1) & 0xFF)
+        records.append((t, DHCP_REQUEST, gate, "", "", ip, False))
+    return records
+
+
+TRACES = {
+    "boot_storm": boot_storm,
+    "steady_renewal": steady_renewal,
+    "starvation_attack": starvation_attack,
+    "dns_heavy": dns_heavy,
+}
+
+# Too big for the default replay network; used by the MassExpiry config
+LARGE_TRACES = {
+    "mass_expiry": mass_expiry,
+}
+
+
+def write_trace(path, records):
+    records = follow_handshake(records)
+    with open(path, "wb") as f:
+        f.write(b"SDTR" + bytes([1]))
+        for t, type, gate, mac, hostname, ip, attack in records:
+            f.write(encode_record(t, type, gate, mac, hostname, ip, attack))
+    return len(records)
+
+
+def main(outdir):
+    for name, generate in list(TRACES.items()) + list(LARGE_TRACES.items()):
+        records = generate(random.Random(name))
+        path = os.path.join(outdir, name + ".trace")
+        count = write_trace(path, records)
+        print("%s: %d messages" % (path, count))
+
+
+if __name__ == "__main__":
+    main(sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__)))
@@ -0,0 +1,89 @@
+#include "AllocationPolicy.h"
+
+AllocationPolicy *AllocationPolicy::create(const std::string& name)
+{
+    if (name == "sequential") return new SequentialPolicy();
+    if (name == "machash") return new MacHashPolicy();
+    if (name == "lrf") return new LeastRecentlyFreedPolicy();
+    return nullptr;
+}
+
+void SequentialPolicy::addAddress(uint32_t ip)
+{
+    freeIPs.insert(ip);
+}
+
+bool SequentialPolicy::removeAddress(uint32_t ip)
+{
+    return freeIPs.erase(ip) > 0;
+}
+
+bool SequentialPolicy::allocate(const std::string& clientMAC, uint32_t& ip)
+{
+    if (freeIPs.empty()) return false;
+
+    ip = *freeIPs.begin();
+    freeIPs.erase(freeIPs.begin());
+    return true;
+}
+
+uint32_t MacHashPolicy::hashMAC(const std::string& mac)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (char c : mac) {
+        hash ^= (unsigned char)c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void MacHashPolicy::addAddress(uint32_t ip)
+{
+    if (ip < lowest) lowest = ip;
+    if (ip > highest) highest = ip;
+    SequentialPolicy::addAddress(ip);
+}
+
+bool MacHashPolicy::allocate(const std::string& clientMAC, uint32_t& ip)
+{
+    if (freeIPs.empty()) return false;
+
+    uint32_t span = highest - lowest + 1;
+    uint32_t home = lowest + hashMAC(clientMAC) % span;
+
+    // First free address at or after the home address, wrapping around
+    auto it = freeIPs.lower_bound(home);
+    if (it == freeIPs.end()) {
+        it = freeIPs.begin();
+    }
+    ip = *it;
+    freeIPs.erase(it);
+    return true;
+}
+
+void LeastRecentlyFreedPolicy::addAddress(uint32_t ip)
+{
+    if (position.count(ip) > 0) return;
+    position[ip] = freeQueue.insert(freeQueue.end(), ip);
+}
+
+bool LeastRecentlyFreedPolicy::removeAddress(uint32_t ip)
+{
+    auto it = position.find(ip);
+    if (it == position.end()) return false;
+
+    freeQueue.erase(it->second);
+    position.erase(it);
+    return true;
+}
+
+bool LeastRecentlyFreedPolicy::allocate(const std::string& clientMAC, uint32_t& ip)
+{
+    if (freeQueue.empty()) return false;
+
+    ip = freeQueue.front();
+    freeQueue.pop_front();
+    position.erase(ip);
+    return true;
+}
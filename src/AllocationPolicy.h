@@ -0,0 +1,73 @@
+#ifndef __ALLOCATIONPOLICY_H
+#define __ALLOCATIONPOLICY_H
+
+#include <cstdint>
+#include <list>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+// Strategy for picking a free address out of one pool.
+// Addresses are handled as host-order integers so ordering is numeric.
+class AllocationPolicy
+{
+public:
+    virtual ~AllocationPolicy() {}
+
+    // Return an address to the free set
+    virtual void addAddress(uint32_t ip) = 0;
+    // Take a specific address out of the free set; false if it was not free
+    virtual bool removeAddress(uint32_t ip) = 0;
+    // Pick a free address for the client; false if the pool is exhausted
+    virtual bool allocate(const std::string& clientMAC, uint32_t& ip) = 0;
+    virtual size_t available() const = 0;
+
+    // Factory: "sequential", "machash" or "lrf"; nullptr for unknown names
+    static AllocationPolicy *create(const std::string& name);
+};
+
+// Lowest free address first, O(log n)
+class SequentialPolicy : public AllocationPolicy
+{
+protected:
+    std::set<uint32_t> freeIPs;
+
+public:
+    virtual void addAddress(uint32_t ip) override;
+    virtual bool removeAddress(uint32_t ip) override;
+    virtual bool allocate(const std::string& clientMAC, uint32_t& ip) override;
+    virtual size_t available() const override { return freeIPs.size(); }
+};
+
+// Sticky: hashes the MAC to a home address and takes the first free one
+// at or after it, so a returning client gets its old address without a lease record. O(log n)
+class MacHashPolicy : public SequentialPolicy
+{
+private:
+    uint32_t lowest;
+    uint32_t highest;
+
+    static uint32_t hashMAC(const std::string& mac);
+
+public:
+    MacHashPolicy() : lowest(UINT32_MAX), highest(0) {}
+
+    virtual void addAddress(uint32_t ip) override;
+    virtual bool allocate(const std::string& clientMAC, uint32_t& ip) override;
+};
+
+// Hands out the address that has been free the longest, O(1)
+class LeastRecentlyFreedPolicy : public AllocationPolicy
+{
+private:
+    std::list<uint32_t> freeQueue;  // Oldest free address at the front
+    std::unordered_map<uint32_t, std::list<uint32_t>::iterator> position;
+
+public:
+    virtual void addAddress(uint32_t ip) override;
+    virtual bool removeAddress(uint32_t ip) override;
+    virtual bool allocate(const std::string& clientMAC, uint32_t& ip) override;
+    virtual size_t available() const override { return freeQueue.size(); }
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "SecondaryResolver.h"
+#include <sstream>
+
+void SecondaryResolver::initialize()
+{
+    serial = 0;
+    refreshInterval = par("refreshInterval");
+    fullTransfer = par("fullTransfer");
+
+    refreshEvent = new cMessage("REFRESH_ZONE");
+    refreshEvent->addPar("type") = REFRESH_ZONE;
+    scheduleAt(par("startTime"), refreshEvent);
+
+    EV << "Secondary resolver initialized, " << (fullTransfer ? "full" : "incremental") << " transfers\n";
+}
+
+void SecondaryResolver::sendZoneQuery()
+{
+    cMessage *query = new cMessage("ZONE_XFR_QUERY");
+    query->addPar("type") = ZONE_XFR_QUERY;
+    query->addPar("serial") = (long)serial;
+    query->addPar("full") = fullTransfer;
+
+    send(query, "port$o");
+}
+
+void SecondaryResolver::applyLines(const std::string& lines)
+{
+    std::istringstream in(lines);
+    std::string line;
+
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string op, hostname, ip;
+        fields >> op >> hostname;
+
+        if (op == "A") {
+            fields >> ip;
+            zone[hostname] = ip;
+        } else if (op == "D") {
+            zone.erase(hostname);
+        }
+    }
+}
+
+void SecondaryResolver::handleZoneResponse(cMessage *msg)
+{
+    bool incremental = msg->par("incremental");
+    std::string changes = msg->par("changes").stringValue();
+
+    if (!incremental) {
+        // Full transfer replaces the local copy
+        zone.clear();
+        applyLines(msg->par("records").stringValue());
+    }
+    applyLines(changes);
+
+    unsigned long newSerial = msg->par("serial").longValue();
+    emit(registerSignal("zoneSynced"), 1L);
+    EV << "Zone synced: serial " << serial << " -> " << newSerial << ", "
+       << zone.size() << " records\n";
+    serial = newSerial;
+}
+
+void SecondaryResolver::handleMessage(cMessage *msg)
+{
+    if (msg->isSelfMessage()) {
+        sendZoneQuery();
+        scheduleAt(simTime() + refreshInterval, refreshEvent);
+        return;
+    }
+
+    int msgType = msg->par("type");
+    if (msgType == ZONE_XFR_RESPONSE) {
+        handleZoneResponse(msg);
+    }
+
+    delete msg;
+}
+
+void SecondaryResolver::finish()
+{
+    cancelAndDelete(refreshEvent);
+
+    recordScalar("zoneRecords", zone.size());
+
+    EV << "=== Secondary Resolver " << getIndex() << " Statistics ===\n";
+    EV << "Zone serial: " << serial << "\n";
+    EV << "Zone records: " << zone.size() << "\n";
+}
@@ -0,0 +1,38 @@
+#ifndef __SECONDARYRESOLVER_H
+#define __SECONDARYRESOLVER_H
+
+#include <omnetpp.h>
+#include <map>
+#include <string>
+
+using namespace omnetpp;
+
+class SecondaryResolver : public cSimpleModule
+{
+private:
+    enum MessageType {
+        ZONE_XFR_QUERY = 8,
+        ZONE_XFR_RESPONSE = 9,
+        REFRESH_ZONE = 30
+    };
+
+    std::map<std::string, std::string> zone;  // Hostname -> IP
+    unsigned long serial;
+    simtime_t refreshInterval;
+    bool fullTransfer;
+
+    cMessage *refreshEvent;
+
+protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+
+    void sendZoneQuery();
+    void handleZoneResponse(cMessage *msg);
+    void applyLines(const std::string& lines);
+};
+
+Define_Module(SecondaryResolver);
+
+#endif
@@ -14,6 +14,12 @@ void SmartClient::initialize()
     renewEvent = nullptr;
     dnsQueryEvent = nullptr;
 
+    leaveEvent = new cMessage("LEAVE_NETWORK");
+    leaveEvent->addPar("type") = LEAVE_NETWORK;
+
+    retryEvent = new cMessage("RETRY_REQUEST");
+    retryEvent->addPar("type") = RETRY_REQUEST;
+
     EV << "Client initialized, will start DHCP at " << par("startTime").doubleValue() << "s\n";
 }
 
@@ -21,7 +27,7 @@ std::string SmartClient::getMyMAC()
 {
     // Generate MAC based on module index
     int index = getIndex();
-    char mac[18];
+    char mac[32];  // Indices >= 100 need more than two digits
     sprintf(mac, "AA:BB:CC:DD:EE:%02d", index + 1);
     return std::string(mac);
 }
@@ -34,6 +40,12 @@ void SmartClient::sendDHCPDiscover()
     discover->addPar("type") = DHCP_DISCOVER;
     discover->addPar("clientMAC") = getMyMAC().c_str();
 
+    // A relay stamps its own address so the server picks the matching subnet
+    const char *relayAddress = par("relayAddress").stringValue();
+    if (strlen(relayAddress) > 0) {
+        discover->addPar("relayAddress") = relayAddress;
+    }
+
     send(discover, "port$o");
     state = WAIT_OFFER;
 }
@@ -51,6 +63,7 @@ void SmartClient::handleDHCPOffer(cMessage *msg)
 void SmartClient::sendDHCPRequest(const std::string& requestIP)
 {
     EV << "Sending DHCP REQUEST for " << requestIP << "\n";
+    requestedIP = requestIP;
 
     cMessage *request = new cMessage("DHCP_REQUEST");
     request->addPar("type") = DHCP_REQUEST;
@@ -78,6 +91,12 @@ void SmartClient::handleDHCPAck(cMessage *msg)
     renewEvent->addPar("type") = RENEW_LEASE;
     scheduleAt(simTime() + (leaseTime * 0.5), renewEvent);
 
+    // Schedule leaving the network (churn), unless already scheduled by an earlier ACK
+    simtime_t sessionTime = par("sessionTime");
+    if (sessionTime > 0 && !leaveEvent->isScheduled()) {
+        scheduleAt(simTime() + sessionTime, leaveEvent);
+    }
+
     // Schedule a DNS query to test the system (query for another host)
     if (getIndex() == 0) {  // Only first client does DNS queries
         dnsQueryEvent = new cMessage("SEND_DNS_QUERY");
@@ -86,6 +105,17 @@ void SmartClient::handleDHCPAck(cMessage *msg)
     }
 }
 
+void SmartClient::handleRejection(cMessage *msg)
+{
+    emit(registerSignal("requestRejected"), 1L);
+    EV << "Request rejected by server (" << msg->par("reason").stringValue() << ")\n";
+
+    // Retry the pending DHCP step after a back-off instead of waiting forever
+    if ((state == WAIT_OFFER || state == WAIT_ACK) && !retryEvent->isScheduled()) {
+        scheduleAt(simTime() + par("retryDelay").doubleValue(), retryEvent);
+    }
+}
+
 void SmartClient::sendDNSQuery(const std::string& hostname)
 {
     EV << "Sending DNS QUERY for " << hostname << "\n";
@@ -123,6 +153,22 @@ void SmartClient::handleMessage(cMessage *msg)
             EV << "Renewing lease...\n";
             sendDHCPRequest(myIP);
             state = WAIT_ACK;
+        } else if (msgType == LEAVE_NETWORK) {
+            // Go silent and let the lease expire, then rejoin with a fresh DISCOVER
+            EV << "Leaving network, releasing " << myIP << " silently\n";
+            if (renewEvent != nullptr) {
+                cancelAndDelete(renewEvent);
+                renewEvent = nullptr;
+            }
+            state = INIT;
+            cancelEvent(retryEvent);
+            scheduleAt(simTime() + par("offTime").doubleValue(), startEvent);
+        } else if (msgType == RETRY_REQUEST) {
+            if (state == WAIT_OFFER) {
+                sendDHCPDiscover();
+            } else if (state == WAIT_ACK) {
+                sendDHCPRequest(requestedIP);
+            }
         } else if (msgType == SEND_DNS_QUERY) {
             // Query for different hosts based on index
             if (getIndex() == 0) {
@@ -153,6 +199,9 @@ void SmartClient::handleMessage(cMessage *msg)
         case DNS_RESPONSE:
             handleDNSResponse(msg);
             break;
+        case REQUEST_REJECTED:
+            handleRejection(msg);
+            break;
         default:
             break;
     }
@@ -168,6 +217,11 @@ void SmartClient::finish()
     if (dnsQueryEvent != nullptr && dnsQueryEvent->isScheduled()) {
         cancelAndDelete(dnsQueryEvent);
     }
+    cancelAndDelete(leaveEvent);
+    cancelAndDelete(retryEvent);
+
+    // Clients stuck mid-handshake at the end of the run
+    recordScalar("stranded", state == WAIT_OFFER || state == WAIT_ACK ? 1 : 0);
 
     EV << "=== Client " << getIndex() << " Statistics ===\n";
     EV << "Final IP: " << myIP << "\n";
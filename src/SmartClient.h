@@ -26,18 +26,24 @@ private:
         DNS_RESPONSE = 6,
         START_DHCP = 10,
         RENEW_LEASE = 11,
-        SEND_DNS_QUERY = 12
+        SEND_DNS_QUERY = 12,
+        LEAVE_NETWORK = 13,
+        REQUEST_REJECTED = 14,
+        RETRY_REQUEST = 15
     };
 
     State state;
     std::string myIP;
     std::string myHostname;
     std::string offeredIP;
+    std::string requestedIP;  // Address in the last REQUEST (for retries)
     int leaseTime;
 
     cMessage *startEvent;
     cMessage *renewEvent;
     cMessage *dnsQueryEvent;
+    cMessage *leaveEvent;
+    cMessage *retryEvent;
 
 protected:
     virtual void initialize() override;
@@ -49,6 +55,7 @@ protected:
     void handleDHCPOffer(cMessage *msg);
     void sendDHCPRequest(const std::string& requestIP);
     void handleDHCPAck(cMessage *msg);
+    void handleRejection(cMessage *msg);
 
     // DNS methods
     void sendDNSQuery(const std::string& hostname);
@@ -1,6 +1,7 @@
 #include "SmartServer.h"
 #include <sstream>
 #include <algorithm>
+#include <chrono>
 
 void SmartServer::initialize()
 {
@@ -10,6 +11,13 @@ void SmartServer::initialize()
     gateway = par("gateway").stringValue();
     dnsServer = par("dnsServer").stringValue();
     leaseTime = par("leaseTime");
+    allocationPolicy = par("allocationPolicy").stdstringValue();
+    poolSelection = par("poolSelection").stdstringValue();
+    if (poolSelection != "first" && poolSelection != "gate") {
+        throw cRuntimeError("Unknown poolSelection '%s' (expected first or gate)", poolSelection.c_str());
+    }
+    allocationCpuTime = 0;
+    allocations = 0;
 
     // Initialize IP pool
     initializeIPPool(poolRange);
@@ -18,29 +26,118 @@ void SmartServer::initialize()
     const char* friendlyNamesStr = par("friendlyNames").stringValue();
     parseFriendlyNames(friendlyNamesStr);
 
-    EV << "SmartServer initialized with " << availableIPs.size() << " available IPs\n";
+    // Security
+    enableSecurity = par("enableSecurity");
+    maxRequestsPerMinute = par("maxRequestsPerMinute");
+    parseMacWhitelist(par("macWhitelist").stringValue());
+
+    // Ingress queue and overload control
+    serviceTime = par("serviceTime");
+    queueCapacity = par("queueCapacity");
+    priorityQueueing = par("priorityQueueing");
+    queueDelayTarget = par("queueDelayTarget");
+    queueDelayInterval = par("queueDelayInterval");
+    queueLength = 0;
+    firstAboveTime = 0;
+    shedding = false;
+    inService = nullptr;
+    serviceTimer = new cMessage("SERVICE_DONE");
+
+    const char *classNames[NUM_CLASSES] = { "Renewal", "Dns", "Discover", "Unknown" };
+    for (int i = 0; i < NUM_CLASSES; i++) {
+        queueDelaySignal[i] = registerSignal((std::string("queueDelay") + classNames[i]).c_str());
+        droppedSignal[i] = registerSignal((std::string("dropped") + classNames[i]).c_str());
+    }
+
+    // Lease expiry
+    expirySweepInterval = par("expirySweepInterval");
+    quarantineTime = par("quarantineTime");
+    expiryCpuTime = 0;
+    expiryWallTime = 0;
+    expiryEvents = 0;
+    leasesExpired = 0;
+    sweepTimer = nullptr;
+    if (expirySweepInterval > 0) {
+        sweepTimer = new cMessage("LEASE_SWEEP");
+        scheduleAt(simTime() + expirySweepInterval, sweepTimer);
+    }
+
+    // Trace recording
+    const char* traceFile = par("traceFile").stringValue();
+    if (strlen(traceFile) > 0) {
+        if (!traceWriter.open(traceFile)) {
+            throw cRuntimeError("Cannot open trace file '%s' for writing", traceFile);
+        }
+        EV << "Recording incoming messages to " << traceFile << "\n";
+    }
+
+    // Zone change feed
+    zoneLog.setCapacity(par("zoneLogCapacity").intValue());
+    zoneSnapshotInterval = par("zoneSnapshotInterval");
+    zoneTransferCpuTime = 0;
+    incrementalTransfers = 0;
+    fullTransfers = 0;
+    zoneSnapshotTimer = nullptr;
+    if (zoneSnapshotInterval > 0) {
+        zoneSnapshotTimer = new cMessage("ZONE_SNAPSHOT");
+        scheduleAt(simTime() + zoneSnapshotInterval, zoneSnapshotTimer);
+    }
+
+    EV << "SmartServer initialized with " << availableIPCount() << " available IPs in "
+       << pools.size() << " pool(s), " << allocationPolicy << " allocation\n";
     EV << "Friendly name mappings: " << friendlyNameMap.size() << "\n";
 }
 
 void SmartServer::initializeIPPool(const char* poolRange)
 {
-    std::string range(poolRange);
-    size_t dashPos = range.find('-');
-
-    if (dashPos == std::string::npos) return;
+    // One or more ranges separated by ';', e.g. "10.0.1.10-10.0.1.50;10.0.2.10-10.0.2.50"
+    // subnetMask and gateway list one entry per range; missing entries repeat the last one
+    std::stringstream ss(poolRange);
+    std::stringstream masks(subnetMask);
+    std::stringstream gateways(gateway);
+    std::string range;
+    std::string mask;
+    std::string gw;
+
+    while (std::getline(ss, range, ';')) {
+        std::string entry;
+        if (std::getline(masks, entry, ';')) mask = entry;
+        if (std::getline(gateways, entry, ';')) gw = entry;
+
+        size_t dashPos = range.find('-');
+        if (dashPos == std::string::npos) continue;
+
+        AddressPool pool;
+        pool.first = ipToInt(range.substr(0, dashPos));
+        pool.last = ipToInt(range.substr(dashPos + 1));
+        pool.subnetMask = mask;
+        pool.gateway = gw;
+        pool.policy = AllocationPolicy::create(allocationPolicy);
+        pool.quarantined = 0;
+        if (pool.policy == nullptr) {
+            throw cRuntimeError("Unknown allocationPolicy '%s' (expected sequential, machash or lrf)",
+                                allocationPolicy.c_str());
+        }
 
-    std::string startIP = range.substr(0, dashPos);
-    std::string endIP = range.substr(dashPos + 1);
+        for (uint32_t ip = pool.first; ip <= pool.last; ip++) {
+            pool.policy->addAddress(ip);
+        }
+        pools.push_back(pool);
+    }
+}
 
-    // Simple IP generation (assumes class C: 192.168.1.x)
-    size_t lastDot = startIP.rfind('.');
-    std::string prefix = startIP.substr(0, lastDot + 1);
-    int startHost = std::stoi(startIP.substr(lastDot + 1));
-    int endHost = std::stoi(endIP.substr(endIP.rfind('.') + 1));
+uint32_t SmartServer::ipToInt(const std::string& ip)
+{
+    unsigned int a = 0, b = 0, c = 0, d = 0;
+    sscanf(ip.c_str(), "%u.%u.%u.%u", &a, &b, &c, &d);
+    return (a << 24) | (b << 16) | (c << 8) | d;
+}
 
-    for (int i = startHost; i <= endHost; i++) {
-        availableIPs.insert(prefix + std::to_string(i));
-    }
+std::string SmartServer::intToIP(uint32_t ip)
+{
+    char buf[16];
+    sprintf(buf, "%u.%u.%u.%u", ip >> 24, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF);
+    return std::string(buf);
 }
 
 void SmartServer::parseFriendlyNames(const char* mappings)
@@ -65,10 +162,24 @@ void SmartServer::parseFriendlyNames(const char* mappings)
     }
 }
 
+void SmartServer::parseMacWhitelist(const char* macs)
+{
+    std::stringstream ss(macs);
+    std::string mac;
+
+    while (std::getline(ss, mac, ',')) {
+        mac.erase(0, mac.find_first_not_of(" \t"));
+        mac.erase(mac.find_last_not_of(" \t") + 1);
+        if (!mac.empty()) {
+            macWhitelist.insert(mac);
+        }
+    }
+}
+
 std::string SmartServer::getClientMAC(int gateIndex)
 {
     // Generate simple MAC based on gate index
-    char mac[18];
+    char mac[32];  // Indices >= 100 need more than two digits
     sprintf(mac, "AA:BB:CC:DD:EE:%02d", gateIndex);
     return std::string(mac);
 }
@@ -87,23 +198,91 @@ std::string SmartServer::generateHostname(const std::string& mac)
     return "host-" + lastByte;
 }
 
-std::string SmartServer::allocateIP(const std::string& clientMAC)
+int SmartServer::selectPool(cMessage *msg)
 {
-    // Check if client already has an IP
-    for (auto& lease : ipLeases) {
-        if (lease.second.clientMAC == clientMAC) {
-            return lease.first; // Return existing IP
+    if (pools.empty()) return -1;
+
+    // Relayed requests are served from the relay's subnet
+    if (msg->hasPar("relayAddress")) {
+        uint32_t relay = ipToInt(msg->par("relayAddress").stringValue());
+        for (size_t i = 0; i < pools.size(); i++) {
+            uint32_t mask = ipToInt(pools[i].subnetMask);
+            if ((pools[i].first & mask) == (relay & mask)) {
+                return i;
+            }
         }
     }
 
+    if (poolSelection == "gate") {
+        return msg->getArrivalGate()->getIndex() % pools.size();
+    }
+
+    // "first": first pool that still has free addresses, then one that can
+    // give up a quarantined address
+    for (size_t i = 0; i < pools.size(); i++) {
+        if (pools[i].policy->available() > 0) {
+            return i;
+        }
+    }
+    for (size_t i = 0; i < pools.size(); i++) {
+        if (pools[i].quarantined > 0) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+int SmartServer::findPool(uint32_t ip)
+{
+    for (size_t i = 0; i < pools.size(); i++) {
+        if (ip >= pools[i].first && ip <= pools[i].last) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+size_t SmartServer::availableIPCount()
+{
+    size_t count = 0;
+    for (auto& pool : pools) {
+        count += pool.policy->available();
+    }
+    return count;
+}
+
+std::string SmartServer::allocateIP(const std::string& clientMAC, int poolIndex)
+{
+    // Check if client already has an IP
+    auto existing = macLeases.find(clientMAC);
+    if (existing != macLeases.end()) {
+        return existing->second; // Return existing IP
+    }
+
+    // Re-grant an address still held in quarantine for this client
+    auto held = quarantineByMAC.find(clientMAC);
+    if (held != quarantineByMAC.end()) {
+        uint32_t address = held->second;
+        unquarantine(address);
+        return intToIP(address);
+    }
+
     // Allocate new IP
-    if (availableIPs.empty()) {
+    if (poolIndex < 0) {
         return ""; // No IPs available
     }
 
-    std::string ip = *availableIPs.begin();
-    availableIPs.erase(availableIPs.begin());
-    return ip;
+    auto start = std::chrono::steady_clock::now();
+    uint32_t ip;
+    bool found = pools[poolIndex].policy->allocate(clientMAC, ip);
+    if (!found && takeQuarantined(poolIndex)) {
+        // Pool exhausted: the oldest quarantined address goes back into circulation
+        found = pools[poolIndex].policy->allocate(clientMAC, ip);
+    }
+    allocationCpuTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    allocations++;
+
+    return found ? intToIP(ip) : "";
 }
 
 void SmartServer::registerDNS(const std::string& hostname, const std::string& ip, simtime_t expiry)
@@ -112,18 +291,106 @@ void SmartServer::registerDNS(const std::string& hostname, const std::string& ip
     record.ipAddress = ip;
     record.expiry = expiry;
     dnsRecords[hostname] = record;
+    zoneLog.recordAdd(hostname, ip, expiry);
 
     emit(registerSignal("dnsRegistered"), 1L);
     EV << "DNS registered: " << hostname << " -> " << ip << " (expires at " << expiry << ")\n";
 }
 
+void SmartServer::unquarantine(uint32_t address)
+{
+    auto it = quarantine.find(address);
+    if (it == quarantine.end()) return;
+
+    auto byMAC = quarantineByMAC.find(it->second.clientMAC);
+    if (byMAC != quarantineByMAC.end() && byMAC->second == address) {
+        quarantineByMAC.erase(byMAC);
+    }
+    quarantineExpiry.erase(std::make_pair(it->second.until, address));
+    pools[it->second.poolIndex].quarantined--;
+    quarantine.erase(it);
+}
+
+void SmartServer::reclaimQuarantine()
+{
+    // Addresses whose grace period is over go back to their pool
+    while (!quarantineExpiry.empty() && quarantineExpiry.begin()->first <= simTime()) {
+        uint32_t address = quarantineExpiry.begin()->second;
+        int poolIndex = quarantine.at(address).poolIndex;
+        unquarantine(address);
+        pools[poolIndex].policy->addAddress(address);
+    }
+}
+
+bool SmartServer::takeQuarantined(int poolIndex)
+{
+    if (pools[poolIndex].quarantined == 0) return false;
+
+    // Earliest-expiring entry of this pool, its holder is least likely to return
+    for (auto& entry : quarantineExpiry) {
+        uint32_t address = entry.second;
+        if (quarantine.at(address).poolIndex == poolIndex) {
+            unquarantine(address);
+            pools[poolIndex].policy->addAddress(address);
+            return true;
+        }
+    }
+    return false;
+}
+
+void SmartServer::returnToPool(uint32_t address, int poolIndex, const std::string& clientMAC)
+{
+    if (poolIndex < 0) return;
+
+    if (quarantineTime <= 0) {
+        pools[poolIndex].policy->addAddress(address);
+        return;
+    }
+
+    // Only the most recent address per MAC is held back
+    auto held = quarantineByMAC.find(clientMAC);
+    if (held != quarantineByMAC.end()) {
+        uint32_t previous = held->second;
+        int previousPool = quarantine.at(previous).poolIndex;
+        unquarantine(previous);
+        pools[previousPool].policy->addAddress(previous);
+    }
+
+    QuarantinedIP entry;
+    entry.clientMAC = clientMAC;
+    entry.until = simTime() + quarantineTime;
+    entry.poolIndex = poolIndex;
+    quarantine[address] = entry;
+    quarantineByMAC[clientMAC] = address;
+    quarantineExpiry.insert(std::make_pair(entry.until, address));
+    pools[poolIndex].quarantined++;
+}
+
+void SmartServer::freeLease(std::map<std::string, IPLease>::iterator it)
+{
+    const std::string& ip = it->first;
+    const IPLease& lease = it->second;
+
+    // Remove DNS entry
+    if (dnsRecords.erase(lease.hostname) > 0) {
+        zoneLog.recordDelete(lease.hostname);
+    }
+
+    // Return IP to pool
+    returnToPool(lease.address, lease.poolIndex, lease.clientMAC);
+    auto macIt = macLeases.find(lease.clientMAC);
+    if (macIt != macLeases.end() && macIt->second == ip) {
+        macLeases.erase(macIt);
+    }
+    ipLeases.erase(it);
+}
+
 void SmartServer::releaseIP(const std::string& ip)
 {
     auto it = ipLeases.find(ip);
     if (it != ipLeases.end()) {
-        // Remove DNS entry
         std::string hostname = it->second.hostname;
-        dnsRecords.erase(hostname);
+        leaseExpiryIndex.erase(std::make_pair(it->second.leaseExpiry, ip));
 
         // Cancel timer
         if (leaseTimers.count(ip) > 0) {
@@ -131,14 +398,38 @@ void SmartServer::releaseIP(const std::string& ip)
             leaseTimers.erase(ip);
         }
 
-        // Return IP to pool
-        availableIPs.insert(ip);
-        ipLeases.erase(it);
+        freeLease(it);
 
         EV << "Released IP " << ip << " and removed DNS entry for " << hostname << "\n";
     }
 }
 
+void SmartServer::recordTrace(cMessage *msg)
+{
+    TraceRecord record;
+    record.time = simTime().dbl();
+    record.type = msg->par("type");
+    record.gate = msg->getArrivalGate()->getIndex();
+    record.isAttack = msg->hasPar("isAttack") && msg->par("isAttack").boolValue();
+    record.serial = msg->hasPar("serial") ? msg->par("serial").longValue() : 0;
+    record.clientMAC = msg->hasPar("clientMAC") ? msg->par("clientMAC").stringValue() : "";
+    record.hostname = msg->hasPar("hostname") ? msg->par("hostname").stringValue() : "";
+    record.requestedIP = msg->hasPar("requestedIP") ? msg->par("requestedIP").stringValue() : "";
+    traceWriter.write(record);
+}
+
+cMessage *SmartServer::createReply(cMessage *request, const char *name, int type)
+{
+    cMessage *reply = new cMessage(name);
+    reply->addPar("type") = type;
+
+    // Echo the replay driver's sequence number so it can match responses
+    if (request->hasPar("seq")) {
+        reply->addPar("seq") = request->par("seq").longValue();
+    }
+    return reply;
+}
+
 void SmartServer::handleDHCPDiscover(cMessage *msg)
 {
     int gateIndex = msg->getArrivalGate()->getIndex();
@@ -146,8 +437,9 @@ void SmartServer::handleDHCPDiscover(cMessage *msg)
 
     EV << "DHCP DISCOVER from " << clientMAC << "\n";
 
-    // Allocate IP
-    std::string offeredIP = allocateIP(clientMAC);
+    // Allocate IP; expired quarantine entries count as free for pool selection
+    reclaimQuarantine();
+    std::string offeredIP = allocateIP(clientMAC, selectPool(msg));
 
     if (offeredIP.empty()) {
         EV << "No IP available for " << clientMAC << "\n";
@@ -155,12 +447,15 @@ void SmartServer::handleDHCPDiscover(cMessage *msg)
         return;
     }
 
-    // Send DHCP OFFER
-    cMessage *offer = new cMessage("DHCP_OFFER");
-    offer->addPar("type") = DHCP_OFFER;
+    // Send DHCP OFFER with the settings of the address's subnet
+    int poolIndex = findPool(ipToInt(offeredIP));
+    std::string offerMask = poolIndex >= 0 ? pools[poolIndex].subnetMask : subnetMask.substr(0, subnetMask.find(';'));
+    std::string offerGateway = poolIndex >= 0 ? pools[poolIndex].gateway : gateway.substr(0, gateway.find(';'));
+
+    cMessage *offer = createReply(msg, "DHCP_OFFER", DHCP_OFFER);
     offer->addPar("offeredIP") = offeredIP.c_str();
-    offer->addPar("subnetMask") = subnetMask.c_str();
-    offer->addPar("gateway") = gateway.c_str();
+    offer->addPar("subnetMask") = offerMask.c_str();
+    offer->addPar("gateway") = offerGateway.c_str();
     offer->addPar("dnsServer") = dnsServer.c_str();
     offer->addPar("leaseTime") = leaseTime;
 
@@ -184,26 +479,69 @@ void SmartServer::handleDHCPRequest(cMessage *msg)
         hostname = generateHostname(clientMAC);
     }
 
+    // Take the address out of its pool (no-op for renewals) and track re-lease hits
+    bool renewal = macLeases.count(clientMAC) > 0 && macLeases[clientMAC] == requestedIP;
+    uint32_t address = ipToInt(requestedIP);
+    int poolIndex = findPool(address);
+    if (poolIndex >= 0) {
+        pools[poolIndex].policy->removeAddress(address);
+    }
+    unquarantine(address);
+    if (!renewal) {
+        auto holder = ipLeases.find(requestedIP);
+        if (holder != ipLeases.end()) {
+            auto holderMAC = macLeases.find(holder->second.clientMAC);
+            if (holderMAC != macLeases.end() && holderMAC->second == requestedIP) {
+                macLeases.erase(holderMAC);
+            }
+        }
+
+        auto previous = lastLeasedIP.find(clientMAC);
+        if (previous != lastLeasedIP.end()) {
+            emit(registerSignal("reLeaseHit"), previous->second == requestedIP ? 1L : 0L);
+        }
+        lastLeasedIP[clientMAC] = requestedIP;
+    }
+
     // Create lease
     IPLease lease;
     lease.clientMAC = clientMAC;
     lease.hostname = hostname;
     lease.leaseExpiry = simTime() + leaseTime;
     lease.gateIndex = gateIndex;
+    lease.address = address;
+    lease.poolIndex = poolIndex;
+
+    // Expiry bookkeeping, timed in both modes so expiryCpuTime includes
+    // setting up the expiry as well as carrying it out
+    auto start = std::chrono::steady_clock::now();
+    if (expirySweepInterval > 0) {
+        // Renewal or takeover: the old expiry no longer applies
+        auto previousLease = ipLeases.find(requestedIP);
+        if (previousLease != ipLeases.end()) {
+            leaseExpiryIndex.erase(std::make_pair(previousLease->second.leaseExpiry, requestedIP));
+        }
+        leaseExpiryIndex.insert(std::make_pair(lease.leaseExpiry, requestedIP));
+    } else {
+        // One expiration timer per lease
+        if (leaseTimers.count(requestedIP) > 0) {
+            cancelAndDelete(leaseTimers[requestedIP]);
+        }
+        cMessage *expireMsg = new cMessage("LEASE_EXPIRE");
+        expireMsg->addPar("ip") = requestedIP.c_str();
+        leaseTimers[requestedIP] = expireMsg;
+        scheduleAt(lease.leaseExpiry, expireMsg);
+    }
+    expiryCpuTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
     ipLeases[requestedIP] = lease;
+    macLeases[clientMAC] = requestedIP;
 
     // Register DNS
     registerDNS(hostname, requestedIP, lease.leaseExpiry);
 
-    // Set lease expiration timer
-    cMessage *expireMsg = new cMessage("LEASE_EXPIRE");
-    expireMsg->addPar("ip") = requestedIP.c_str();
-    leaseTimers[requestedIP] = expireMsg;
-    scheduleAt(lease.leaseExpiry, expireMsg);
-
     // Send DHCP ACK
-    cMessage *ack = new cMessage("DHCP_ACK");
-    ack->addPar("type") = DHCP_ACK;
+    cMessage *ack = createReply(msg, "DHCP_ACK", DHCP_ACK);
     ack->addPar("assignedIP") = requestedIP.c_str();
     ack->addPar("hostname") = hostname.c_str();
     ack->addPar("leaseTime") = leaseTime;
@@ -224,8 +562,7 @@ void SmartServer::handleDNSQuery(cMessage *msg)
     EV << "DNS QUERY for " << queryHostname << "\n";
 
     // Lookup DNS record
-    cMessage *response = new cMessage("DNS_RESPONSE");
-    response->addPar("type") = DNS_RESPONSE;
+    cMessage *response = createReply(msg, "DNS_RESPONSE", DNS_RESPONSE);
     response->addPar("hostname") = queryHostname.c_str();
 
     auto it = dnsRecords.find(queryHostname);
@@ -245,20 +582,290 @@ void SmartServer::handleDNSQuery(cMessage *msg)
 
 void SmartServer::handleLeaseExpire(cMessage *msg)
 {
+    auto start = std::chrono::steady_clock::now();
+
     std::string ip = msg->par("ip").stringValue();
     EV << "Lease expired for IP " << ip << "\n";
 
+    bool expired = ipLeases.count(ip) > 0;
+    leaseTimers.erase(ip);  // msg is deleted below, don't cancel it again
     releaseIP(ip);
     delete msg;
+
+    expiryCpuTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (expired) {
+        leasesExpired++;
+        recordExpiryEvent(start);
+    }
+}
+
+void SmartServer::recordExpiryEvent(std::chrono::steady_clock::time_point start)
+{
+    // Wall time from the first to the last expiring event also covers the
+    // simulation kernel's scheduling and dispatch of every expiry event
+    if (expiryEvents++ == 0) {
+        expiryWindowStart = start;
+    }
+    expiryWallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - expiryWindowStart).count();
+}
+
+void SmartServer::sweepLeases()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // One pass over the expiry index: everything due by now goes at once
+    long expired = 0;
+    while (!leaseExpiryIndex.empty() && leaseExpiryIndex.begin()->first <= simTime()) {
+        auto entry = leaseExpiryIndex.begin();
+        auto lease = ipLeases.find(entry->second);
+        leaseExpiryIndex.erase(entry);
+        if (lease != ipLeases.end()) {
+            freeLease(lease);
+            expired++;
+        }
+    }
+    reclaimQuarantine();
+
+    leasesExpired += expired;
+    expiryCpuTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (expired > 0) {
+        recordExpiryEvent(start);
+        emit(registerSignal("leasesSwept"), expired);
+        EV << "Lease sweep expired " << expired << " leases, " << availableIPCount() << " IPs available, "
+           << quarantine.size() << " quarantined\n";
+    }
+
+    scheduleAt(simTime() + expirySweepInterval, sweepTimer);
+}
+
+void SmartServer::encodeZone(std::string& out)
+{
+    for (auto& record : dnsRecords) {
+        ZoneChangeLog::encodeRecord(out, record.first, record.second.ipAddress, record.second.expiry);
+    }
+}
+
+void SmartServer::takeZoneSnapshot()
+{
+    std::string body;
+    encodeZone(body);
+    zoneLog.setSnapshot(body, dnsRecords.size());
+}
+
+void SmartServer::handleZoneTransfer(cMessage *msg)
+{
+    int gateIndex = msg->getArrivalGate()->getIndex();
+    unsigned long clientSerial = msg->par("serial").longValue();
+    bool fullRequested = msg->hasPar("full") && msg->par("full").boolValue();
+
+    auto start = std::chrono::steady_clock::now();
+
+    cMessage *response = createReply(msg, "ZONE_XFR_RESPONSE", ZONE_XFR_RESPONSE);
+    response->addPar("serial") = (long)zoneLog.getSerial();
+
+    std::string records;
+    std::string changes;
+    int changeCount = 0;
+    unsigned long fromSerial = clientSerial;
+    bool incremental = !fullRequested && zoneLog.canServeDeltas(clientSerial);
+
+    if (incremental) {
+        // IXFR: only the net changes since the secondary's serial
+        changeCount = zoneLog.encodeDeltas(clientSerial, changes);
+        incrementalTransfers++;
+    } else if (fullRequested) {
+        // Explicit AXFR: serialize the current zone
+        encodeZone(records);
+        fromSerial = zoneLog.getSerial();
+        fullTransfers++;
+    } else {
+        // Full transfer: last snapshot plus the changes made after it
+        if (!zoneLog.hasUsableSnapshot()) {
+            takeZoneSnapshot();
+        }
+        records = zoneLog.getSnapshot();
+        fromSerial = zoneLog.getSnapshotSerial();
+        changeCount = zoneLog.encodeDeltas(fromSerial, changes);
+        fullTransfers++;
+    }
+
+    response->addPar("incremental") = incremental;
+    response->addPar("fromSerial") = (long)fromSerial;
+    response->addPar("records") = records.c_str();
+    response->addPar("changes") = changes.c_str();
+    response->addPar("changeCount") = changeCount;
+
+    zoneTransferCpuTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long bytes = records.size() + changes.size();
+    emit(registerSignal("zoneXfrBytes"), bytes);
+    EV << (incremental ? "IXFR" : "AXFR") << " to gate " << gateIndex << ": serial " << clientSerial
+       << " -> " << zoneLog.getSerial() << ", " << changeCount << " changes, " << bytes << " bytes\n";
+
+    send(response, "port$o", gateIndex);
+    delete msg;
+}
+
+SmartServer::TrafficClass SmartServer::classify(cMessage *msg)
+{
+    std::string clientMAC = getClientMAC(msg->getArrivalGate()->getIndex());
+    auto lease = macLeases.find(clientMAC);
+    int msgType = msg->par("type");
+
+    switch (msgType) {
+        case DHCP_REQUEST:
+            if (lease != macLeases.end() && lease->second == msg->par("requestedIP").stringValue()) {
+                return CLASS_RENEWAL;
+            }
+            break;
+        case DNS_QUERY:
+        case ZONE_XFR_QUERY:
+            if (lease != macLeases.end() || msgType == ZONE_XFR_QUERY) {
+                return CLASS_DNS;
+            }
+            break;
+    }
+
+    // Known: the gate's MAC is whitelisted, friendly-named or held a lease before.
+    // The self-declared clientMAC par is not trusted, any sender can claim one
+    if (macWhitelist.count(clientMAC) > 0 || friendlyNameMap.count(clientMAC) > 0
+            || lastLeasedIP.count(clientMAC) > 0) {
+        return CLASS_DISCOVER;
+    }
+    return CLASS_UNKNOWN;
+}
+
+void SmartServer::reject(cMessage *msg, int trafficClass, const char *reason)
+{
+    int gateIndex = msg->getArrivalGate()->getIndex();
+
+    cMessage *rejection = createReply(msg, "REQUEST_REJECTED", REQUEST_REJECTED);
+    rejection->addPar("blocked") = true;
+    rejection->addPar("reason") = reason;
+    send(rejection, "port$o", gateIndex);
+
+    emit(droppedSignal[trafficClass], 1L);
+    EV << "Rejected " << msg->getName() << " from gate " << gateIndex << " (" << reason << ")\n";
+    delete msg;
+}
+
+void SmartServer::enqueue(cMessage *msg)
+{
+    // Messages are always classified for statistics; without priority
+    // queueing they all share one FIFO (queue 0) and nothing is shed
+    TrafficClass trafficClass = classify(msg);
+    int queueIndex = priorityQueueing ? trafficClass : 0;
+    msg->setKind(trafficClass);
+    msg->setTimestamp();
+
+    // Early rejection of low-priority traffic while the queue is overloaded
+    if (shedding && trafficClass >= CLASS_DISCOVER) {
+        reject(msg, trafficClass, "overload");
+        return;
+    }
+
+    if ((int)queueLength >= queueCapacity) {
+        // Full: push out the newest message of the lowest class below this one (FIFO: tail drop)
+        int victim = NUM_CLASSES - 1;
+        while (victim > queueIndex && ingressQueue[victim].empty()) {
+            victim--;
+        }
+        if (victim <= queueIndex) {
+            reject(msg, trafficClass, "queue full");
+            return;
+        }
+        cMessage *dropped = ingressQueue[victim].back();
+        ingressQueue[victim].pop_back();
+        queueLength--;
+        reject(dropped, victim, "queue full");
+    }
+
+    ingressQueue[queueIndex].push_back(msg);
+    queueLength++;
+
+    if (inService == nullptr) {
+        startService();
+    }
+}
+
+void SmartServer::startService()
+{
+    while (queueLength > 0) {
+        int queueIndex = 0;
+        while (ingressQueue[queueIndex].empty()) {
+            queueIndex++;
+        }
+        cMessage *msg = ingressQueue[queueIndex].front();
+        ingressQueue[queueIndex].pop_front();
+        queueLength--;
+        int trafficClass = msg->getKind();
+
+        // CoDel-like: shed once sojourn time stays above target for a whole interval
+        simtime_t sojourn = simTime() - msg->getTimestamp();
+        if (sojourn < queueDelayTarget || queueLength == 0) {
+            firstAboveTime = 0;
+            shedding = false;
+        } else if (firstAboveTime == 0) {
+            firstAboveTime = simTime() + queueDelayInterval;
+        } else if (simTime() >= firstAboveTime) {
+            shedding = priorityQueueing;
+        }
+
+        if (shedding && trafficClass >= CLASS_DISCOVER) {
+            reject(msg, trafficClass, "queue delay");
+            continue;
+        }
+
+        emit(queueDelaySignal[trafficClass], sojourn);
+        inService = msg;
+        scheduleAt(simTime() + serviceTime, serviceTimer);
+        return;
+    }
 }
 
 void SmartServer::handleMessage(cMessage *msg)
 {
+    if (msg == zoneSnapshotTimer) {
+        // Snapshots serve stale secondaries, so their cost counts as transfer CPU
+        auto start = std::chrono::steady_clock::now();
+        takeZoneSnapshot();
+        zoneTransferCpuTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        scheduleAt(simTime() + zoneSnapshotInterval, zoneSnapshotTimer);
+        return;
+    }
+
+    if (msg == sweepTimer) {
+        sweepLeases();
+        return;
+    }
+
+    if (msg == serviceTimer) {
+        cMessage *done = inService;
+        inService = nullptr;
+        dispatch(done);
+        startService();
+        return;
+    }
+
     if (msg->isSelfMessage()) {
         handleLeaseExpire(msg);
         return;
     }
 
+    if (traceWriter.isOpen()) {
+        recordTrace(msg);
+    }
+
+    if (serviceTime > 0) {
+        enqueue(msg);
+    } else {
+        dispatch(msg);
+    }
+}
+
+void SmartServer::dispatch(cMessage *msg)
+{
     int msgType = msg->par("type");
 
     switch (msgType) {
@@ -271,6 +878,9 @@ void SmartServer::handleMessage(cMessage *msg)
         case DNS_QUERY:
             handleDNSQuery(msg);
             break;
+        case ZONE_XFR_QUERY:
+            handleZoneTransfer(msg);
+            break;
         default:
             delete msg;
             break;
@@ -284,9 +894,46 @@ void SmartServer::finish()
         cancelAndDelete(timer.second);
     }
     leaseTimers.clear();
+    cancelAndDelete(zoneSnapshotTimer);
+    zoneSnapshotTimer = nullptr;
+    cancelAndDelete(sweepTimer);
+    sweepTimer = nullptr;
+    traceWriter.close();
+
+    // Drop whatever is still queued
+    cancelAndDelete(serviceTimer);
+    serviceTimer = nullptr;
+    delete inService;
+    inService = nullptr;
+    for (auto& queue : ingressQueue) {
+        for (cMessage *queued : queue) {
+            delete queued;
+        }
+        queue.clear();
+    }
+    queueLength = 0;
+
+    recordScalar("leasesExpired", leasesExpired);
+    recordScalar("expiryCpuTime", expiryCpuTime, "s");
+    recordScalar("expiryEvents", expiryEvents);
+    recordScalar("expiryWallTime", expiryWallTime, "s");
+    recordScalar("allocations", allocations);
+    recordScalar("allocationCpuTime", allocationCpuTime, "s");
+
+    recordScalar("zoneSerial", zoneLog.getSerial());
+    recordScalar("incrementalTransfers", incrementalTransfers);
+    recordScalar("fullTransfers", fullTransfers);
+    recordScalar("zoneTransferCpuTime", zoneTransferCpuTime, "s");
 
     EV << "=== Server Statistics ===\n";
     EV << "Active leases: " << ipLeases.size() << "\n";
     EV << "DNS records: " << dnsRecords.size() << "\n";
-    EV << "Available IPs: " << availableIPs.size() << "\n";
+    EV << "Available IPs: " << availableIPCount() << "\n";
+    EV << "Zone serial: " << zoneLog.getSerial() << " (" << incrementalTransfers << " incremental, "
+       << fullTransfers << " full transfers)\n";
+
+    for (auto& pool : pools) {
+        delete pool.policy;
+    }
+    pools.clear();
 }
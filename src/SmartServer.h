@@ -2,9 +2,15 @@
 #define __SMARTSERVER_H
 
 #include <omnetpp.h>
+#include <chrono>
+#include <deque>
 #include <map>
 #include <string>
 #include <set>
+#include <vector>
+#include "AllocationPolicy.h"
+#include "TraceFile.h"
+#include "ZoneChangeLog.h"
 
 using namespace omnetpp;
 
@@ -17,6 +23,8 @@ private:
         std::string hostname;
         simtime_t leaseExpiry;
         int gateIndex;
+        uint32_t address;  // Parsed IP, so expiry never re-parses the key
+        int poolIndex;     // Owning pool, -1 if outside every pool
     };
 
     // DNS data structure
@@ -25,11 +33,30 @@ private:
         simtime_t expiry;
     };
 
+    // Address pool (one per subnet range), each with its own allocation strategy
+    struct AddressPool {
+        uint32_t first;
+        uint32_t last;
+        std::string subnetMask;
+        std::string gateway;
+        AllocationPolicy *policy;
+        size_t quarantined;  // Addresses of this pool held in quarantine
+    };
+
     std::map<std::string, IPLease> ipLeases;  // IP -> Lease info
-    std::set<std::string> availableIPs;        // Available IP pool
+    std::map<std::string, std::string> macLeases;  // MAC -> leased IP
+    std::vector<AddressPool> pools;            // Available IP pools
     std::map<std::string, DNSRecord> dnsRecords; // Hostname -> DNS record
     std::map<std::string, std::string> friendlyNameMap; // MAC -> friendly name
 
+    // Zone change feed for secondary resolvers
+    ZoneChangeLog zoneLog;
+    simtime_t zoneSnapshotInterval;
+    cMessage *zoneSnapshotTimer;
+    double zoneTransferCpuTime;  // Wall-clock seconds spent building transfers
+    long incrementalTransfers;
+    long fullTransfers;
+
     // Security structures
     std::set<std::string> macWhitelist;  // Authorized MAC addresses
     std::map<std::string, int> requestCount;  // MAC -> request count
@@ -40,9 +67,42 @@ private:
     int maxRequestsPerMinute;
     bool enableSecurity;
 
+    // Allocation
+    std::string allocationPolicy;
+    std::string poolSelection;
+    std::map<std::string, std::string> lastLeasedIP;  // MAC -> previous IP (re-lease statistics, known-client classification)
+    double allocationCpuTime;  // Wall-clock seconds spent in allocateIP
+    long allocations;
+
+    // Ingress queueing and overload control, highest priority first
+    enum TrafficClass {
+        CLASS_RENEWAL = 0,   // REQUEST renewing an existing lease
+        CLASS_DNS = 1,       // DNS/zone queries from bound clients
+        CLASS_DISCOVER = 2,  // New bindings from known clients
+        CLASS_UNKNOWN = 3,   // Anything else (unknown MACs)
+        NUM_CLASSES = 4
+    };
+
+    std::deque<cMessage*> ingressQueue[NUM_CLASSES];
+    size_t queueLength;
+    int queueCapacity;
+    simtime_t serviceTime;          // Simulated processing time per message, 0 = no queueing
+    bool priorityQueueing;          // false: single FIFO class, no shedding
+    simtime_t queueDelayTarget;     // CoDel-like target sojourn time
+    simtime_t queueDelayInterval;   // Sojourn must stay above target this long before shedding
+    simtime_t firstAboveTime;       // When the above-target interval ends (0 = below target)
+    bool shedding;
+    cMessage *serviceTimer;
+    cMessage *inService;
+    simsignal_t queueDelaySignal[NUM_CLASSES];
+    simsignal_t droppedSignal[NUM_CLASSES];
+
+    // Trace recording of incoming messages (for replay)
+    TraceWriter traceWriter;
+
     // Configuration
-    std::string subnetMask;
-    std::string gateway;
+    std::string subnetMask;  // One entry per ipPool range, ';'-separated
+    std::string gateway;     // One entry per ipPool range, ';'-separated
     std::string dnsServer;
     int leaseTime;
 
@@ -54,12 +114,36 @@ private:
         DHCP_ACK = 4,
         DNS_QUERY = 5,
         DNS_RESPONSE = 6,
-        LEASE_EXPIRE = 7
+        LEASE_EXPIRE = 7,
+        ZONE_XFR_QUERY = 8,
+        ZONE_XFR_RESPONSE = 9,
+        REQUEST_REJECTED = 14
     };
 
     // Self messages for lease expiration
     std::map<std::string, cMessage*> leaseTimers;
 
+    // Lease expiry index, soonest first; drives the sweep mode
+    std::set<std::pair<simtime_t, std::string>> leaseExpiryIndex;  // (expiry, IP)
+    simtime_t expirySweepInterval;  // 0 = one timer per lease
+    cMessage *sweepTimer;
+    double expiryCpuTime;  // Wall-clock seconds spent scheduling and expiring leases
+    double expiryWallTime;  // Wall-clock seconds from the first to the last expiring event
+    long expiryEvents;      // Timer events or sweeps that expired at least one lease
+    std::chrono::steady_clock::time_point expiryWindowStart;
+    long leasesExpired;
+
+    // Grace-period quarantine: freed addresses held for fast re-grant to the same MAC
+    struct QuarantinedIP {
+        std::string clientMAC;
+        simtime_t until;
+        int poolIndex;
+    };
+    simtime_t quarantineTime;
+    std::map<uint32_t, QuarantinedIP> quarantine;     // IP -> previous holder
+    std::map<std::string, uint32_t> quarantineByMAC;  // MAC -> IP
+    std::set<std::pair<simtime_t, uint32_t>> quarantineExpiry;  // (until, IP)
+
 protected:
     virtual void initialize() override;
     virtual void handleMessage(cMessage *msg) override;
@@ -68,15 +152,38 @@ protected:
     // Helper methods
     void initializeIPPool(const char* poolRange);
     void parseFriendlyNames(const char* mappings);
-    std::string allocateIP(const std::string& clientMAC);
+    void parseMacWhitelist(const char* macs);
+    int selectPool(cMessage *msg);
+    int findPool(uint32_t ip);
+    size_t availableIPCount();
+    std::string allocateIP(const std::string& clientMAC, int poolIndex);
+    void recordTrace(cMessage *msg);
+    cMessage *createReply(cMessage *request, const char *name, int type);
+    void dispatch(cMessage *msg);
+    TrafficClass classify(cMessage *msg);
+    void enqueue(cMessage *msg);
+    void startService();
+    void reject(cMessage *msg, int trafficClass, const char *reason);
     void handleDHCPDiscover(cMessage *msg);
     void handleDHCPRequest(cMessage *msg);
     void handleDNSQuery(cMessage *msg);
     void handleLeaseExpire(cMessage *msg);
+    void sweepLeases();
+    void recordExpiryEvent(std::chrono::steady_clock::time_point start);
+    void freeLease(std::map<std::string, IPLease>::iterator it);
+    void returnToPool(uint32_t address, int poolIndex, const std::string& clientMAC);
+    void unquarantine(uint32_t address);
+    void reclaimQuarantine();
+    bool takeQuarantined(int poolIndex);
+    void handleZoneTransfer(cMessage *msg);
+    void encodeZone(std::string& out);
+    void takeZoneSnapshot();
     void registerDNS(const std::string& hostname, const std::string& ip, simtime_t expiry);
     void releaseIP(const std::string& ip);
     std::string generateHostname(const std::string& mac);
     std::string getClientMAC(int gateIndex);
+    static uint32_t ipToInt(const std::string& ip);
+    static std::string intToIP(uint32_t ip);
 };
 
 Define_Module(SmartServer);
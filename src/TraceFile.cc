@@ -0,0 +1,117 @@
+#include "TraceFile.h"
+#include <cstdint>
+#include <cstring>
+
+static const char TRACE_MAGIC[4] = { 'S', 'D', 'T', 'R' };
+static const uint8_t TRACE_VERSION = 1;
+
+static void putUInt(FILE *fp, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        fputc((value >> (8 * i)) & 0xFF, fp);
+    }
+}
+
+static bool getUInt(FILE *fp, uint32_t& value, int bytes)
+{
+    value = 0;
+    for (int i = 0; i < bytes; i++) {
+        int c = fgetc(fp);
+        if (c == EOF) return false;
+        value |= (uint32_t)c << (8 * i);
+    }
+    return true;
+}
+
+static void putString(FILE *fp, const std::string& str)
+{
+    size_t len = str.size() > 255 ? 255 : str.size();
+    fputc((int)len, fp);
+    fwrite(str.data(), 1, len, fp);
+}
+
+static bool getString(FILE *fp, std::string& str)
+{
+    int len = fgetc(fp);
+    if (len == EOF) return false;
+    str.resize(len);
+    return len == 0 || fread(&str[0], 1, len, fp) == (size_t)len;
+}
+
+bool TraceWriter::open(const std::string& path)
+{
+    close();
+    fp = fopen(path.c_str(), "wb");
+    if (fp == nullptr) return false;
+
+    fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC), fp);
+    fputc(TRACE_VERSION, fp);
+    return true;
+}
+
+void TraceWriter::write(const TraceRecord& record)
+{
+    uint64_t timeBits;
+    memcpy(&timeBits, &record.time, sizeof(timeBits));
+    putUInt(fp, (uint32_t)timeBits, 4);
+    putUInt(fp, (uint32_t)(timeBits >> 32), 4);
+
+    putUInt(fp, record.type, 1);
+    putUInt(fp, record.gate, 4);
+    putUInt(fp, record.isAttack ? 1 : 0, 1);
+    putUInt(fp, record.serial, 4);
+    putString(fp, record.clientMAC);
+    putString(fp, record.hostname);
+    putString(fp, record.requestedIP);
+}
+
+void TraceWriter::close()
+{
+    if (fp != nullptr) {
+        fclose(fp);
+        fp = nullptr;
+    }
+}
+
+bool TraceReader::open(const std::string& path)
+{
+    close();
+    fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) return false;
+
+    char magic[sizeof(TRACE_MAGIC)];
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic)
+            || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0
+            || fgetc(fp) != TRACE_VERSION) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool TraceReader::read(TraceRecord& record)
+{
+    if (fp == nullptr) return false;
+
+    uint32_t low, high, type, gate, flags, serial;
+    if (!getUInt(fp, low, 4) || !getUInt(fp, high, 4)) return false;
+    uint64_t timeBits = ((uint64_t)high << 32) | low;
+    memcpy(&record.time, &timeBits, sizeof(timeBits));
+
+    if (!getUInt(fp, type, 1) || !getUInt(fp, gate, 4) || !getUInt(fp, flags, 1) || !getUInt(fp, serial, 4))
+        return false;
+    record.type = type;
+    record.gate = gate;
+    record.isAttack = (flags & 1) != 0;
+    record.serial = serial;
+
+    return getString(fp, record.clientMAC) && getString(fp, record.hostname) && getString(fp, record.requestedIP);
+}
+
+void TraceReader::close()
+{
+    if (fp != nullptr) {
+        fclose(fp);
+        fp = nullptr;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef __TRACEFILE_H
+#define __TRACEFILE_H
+
+#include <cstdio>
+#include <string>
+
+// One incoming server message as captured by the trace recorder
+struct TraceRecord {
+    double time;
+    int type;
+    int gate;
+    bool isAttack;
+    unsigned long serial;  // ZONE_XFR_QUERY only
+    std::string clientMAC;
+    std::string hostname;
+    std::string requestedIP;
+};
+
+// Compact binary trace format:
+//   header: "SDTR" + version byte
+//   record: time (double) | type (u8) | gate (u32) | flags (u8) | serial (u32)
+//           | clientMAC, hostname, requestedIP (u8 length + bytes each)
+// Integers are little-endian.
+class TraceWriter
+{
+private:
+    FILE *fp;
+
+public:
+    TraceWriter() : fp(nullptr) {}
+    ~TraceWriter() { close(); }
+
+    bool open(const std::string& path);
+    void write(const TraceRecord& record);
+    void close();
+    bool isOpen() const { return fp != nullptr; }
+};
+
+class TraceReader
+{
+private:
+    FILE *fp;
+
+public:
+    TraceReader() : fp(nullptr) {}
+    ~TraceReader() { close(); }
+
+    bool open(const std::string& path);
+    bool read(TraceRecord& record);  // false at end of file
+    void close();
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef __TRACEREPLAYER_H
+#define __TRACEREPLAYER_H
+
+#include <omnetpp.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include "TraceFile.h"
+
+using namespace omnetpp;
+
+// Feeds a recorded SmartServer trace back to the server, either at the
+// recorded timing or back-to-back at full speed, and measures responses.
+class TraceReplayer : public cSimpleModule
+{
+private:
+    enum MessageType {
+        DHCP_DISCOVER = 1,
+        DHCP_OFFER = 2,
+        DHCP_REQUEST = 3,
+        DHCP_ACK = 4,
+        DNS_QUERY = 5,
+        DNS_RESPONSE = 6,
+        ZONE_XFR_QUERY = 8,
+        ZONE_XFR_RESPONSE = 9,
+        REPLAY_NEXT = 40
+    };
+
+    TraceReader reader;
+    TraceRecord nextRecord;
+    bool hasNext;
+    bool fullSpeed;
+    double firstTime;
+    simtime_t startTime;
+
+    cMessage *replayEvent;
+
+    // Statistics
+    struct PendingRequest {
+        simtime_t sent;
+        std::chrono::steady_clock::time_point wallSent;
+    };
+    long seq;
+    std::map<long, PendingRequest> pending;  // seq -> send time
+    std::vector<double> latencies;      // Simulated response time
+    std::vector<double> wallLatencies;  // Wall-clock response time (server processing)
+    std::chrono::steady_clock::time_point wallStart;
+    std::chrono::steady_clock::time_point wallEnd;
+
+protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+
+    void sendRecord(const TraceRecord& record);
+    void scheduleNext();
+    void handleResponse(cMessage *msg);
+    static double percentile(const std::vector<double>& sorted, double p);
+};
+
+Define_Module(TraceReplayer);
+
+#endif
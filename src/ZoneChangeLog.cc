@@ -0,0 +1,110 @@
+#include "ZoneChangeLog.h"
+#include <map>
+
+ZoneChangeLog::ZoneChangeLog(size_t capacity)
+    : head(0), count(0), serial(0), snapshotSerial(0), snapshotRecords(0), snapshotValid(false)
+{
+    setCapacity(capacity);
+}
+
+void ZoneChangeLog::setCapacity(size_t capacity)
+{
+    // Resizing drops the history; secondaries fall back to a full transfer
+    ring.assign(capacity > 0 ? capacity : 1, Change());
+    head = 0;
+    count = 0;
+}
+
+void ZoneChangeLog::append(Operation op, const std::string& hostname, const std::string& ip, simtime_t expiry)
+{
+    serial++;
+
+    size_t slot = (head + count) % ring.size();
+    if (count == ring.size()) {
+        // Ring full: overwrite the oldest change
+        head = (head + 1) % ring.size();
+    } else {
+        count++;
+    }
+
+    Change& change = ring[slot];
+    change.serial = serial;
+    change.op = op;
+    change.hostname = hostname;
+    change.ipAddress = ip;
+    change.expiry = expiry;
+}
+
+void ZoneChangeLog::recordAdd(const std::string& hostname, const std::string& ip, simtime_t expiry)
+{
+    append(ADD, hostname, ip, expiry);
+}
+
+void ZoneChangeLog::recordDelete(const std::string& hostname)
+{
+    append(DEL, hostname, "", 0);
+}
+
+bool ZoneChangeLog::canServeDeltas(unsigned long fromSerial) const
+{
+    if (fromSerial > serial) return false;
+    if (fromSerial == serial) return true;
+    if (count == 0) return false;
+
+    // Deltas are complete only if the change right after fromSerial is still held
+    return ring[head].serial <= fromSerial + 1;
+}
+
+int ZoneChangeLog::encodeDeltas(unsigned long fromSerial, std::string& out) const
+{
+    if (fromSerial >= serial || count == 0) return 0;
+
+    // Skip straight to the first change after fromSerial (serials are contiguous)
+    size_t skip = 0;
+    if (fromSerial >= ring[head].serial) {
+        skip = fromSerial - ring[head].serial + 1;
+    }
+
+    // Compact: only the last change per hostname is transferred
+    std::map<std::string, const Change*> latest;
+    for (size_t i = skip; i < count; i++) {
+        const Change& change = ring[(head + i) % ring.size()];
+        latest[change.hostname] = &change;
+    }
+
+    for (auto& entry : latest) {
+        const Change* change = entry.second;
+        if (change->op == ADD) {
+            encodeRecord(out, change->hostname, change->ipAddress, change->expiry);
+        } else {
+            encodeDelete(out, change->hostname);
+        }
+    }
+    return latest.size();
+}
+
+void ZoneChangeLog::setSnapshot(const std::string& body, size_t records)
+{
+    snapshot = body;
+    snapshotSerial = serial;
+    snapshotRecords = records;
+    snapshotValid = true;
+}
+
+void ZoneChangeLog::encodeRecord(std::string& out, const std::string& hostname, const std::string& ip, simtime_t expiry)
+{
+    out += "A ";
+    out += hostname;
+    out += ' ';
+    out += ip;
+    out += ' ';
+    out += expiry.str();
+    out += '\n';
+}
+
+void ZoneChangeLog::encodeDelete(std::string& out, const std::string& hostname)
+{
+    out += "D ";
+    out += hostname;
+    out += '\n';
+}
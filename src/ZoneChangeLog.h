@@ -0,0 +1,71 @@
+#ifndef __ZONECHANGELOG_H
+#define __ZONECHANGELOG_H
+
+#include <omnetpp.h>
+#include <string>
+#include <vector>
+
+using namespace omnetpp;
+
+// Serial-numbered log of DNS zone changes (IXFR-style).
+// Keeps the most recent changes in a fixed-size ring buffer plus a
+// compacted snapshot of the whole zone for secondaries that fell too far behind.
+class ZoneChangeLog
+{
+public:
+    enum Operation {
+        ADD = 'A',
+        DEL = 'D'
+    };
+
+    struct Change {
+        unsigned long serial;
+        Operation op;
+        std::string hostname;
+        std::string ipAddress;
+        simtime_t expiry;
+    };
+
+private:
+    std::vector<Change> ring;  // Circular buffer of recent changes
+    size_t head;               // Index of the oldest change
+    size_t count;              // Number of changes held
+    unsigned long serial;      // Current zone serial
+
+    // Compacted snapshot (encoded full zone)
+    std::string snapshot;
+    unsigned long snapshotSerial;
+    size_t snapshotRecords;
+    bool snapshotValid;
+
+    void append(Operation op, const std::string& hostname, const std::string& ip, simtime_t expiry);
+
+public:
+    explicit ZoneChangeLog(size_t capacity = 1024);
+
+    void setCapacity(size_t capacity);
+    unsigned long getSerial() const { return serial; }
+    size_t size() const { return count; }
+
+    void recordAdd(const std::string& hostname, const std::string& ip, simtime_t expiry);
+    void recordDelete(const std::string& hostname);
+
+    // True if every change after fromSerial is still in the ring
+    bool canServeDeltas(unsigned long fromSerial) const;
+
+    // Appends the net changes after fromSerial (one line per hostname) and returns their count
+    int encodeDeltas(unsigned long fromSerial, std::string& out) const;
+
+    // Snapshot handling; the owner encodes the zone with encodeRecord()
+    void setSnapshot(const std::string& body, size_t records);
+    bool hasUsableSnapshot() const { return snapshotValid && canServeDeltas(snapshotSerial); }
+    const std::string& getSnapshot() const { return snapshot; }
+    unsigned long getSnapshotSerial() const { return snapshotSerial; }
+    size_t getSnapshotRecords() const { return snapshotRecords; }
+
+    // Wire format: "A <hostname> <ip> <expiry>\n" or "D <hostname>\n"
+    static void encodeRecord(std::string& out, const std::string& hostname, const std::string& ip, simtime_t expiry);
+    static void encodeDelete(std::string& out, const std::string& hostname);
+};
+
+#endif